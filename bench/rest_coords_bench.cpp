@@ -0,0 +1,154 @@
+/*
+ * Host benchmark of the rest_coords distance kernel against the record
+ * by record loop manDist() runs on the Arduino.
+ *
+ * Build and run with
+ *   make rest-coords-bench && ./rest-coords-bench [restaurants.bin]
+ * where restaurants.bin is the restaurant data copied off the SD card, e.g.
+ *   dd if=/dev/sdX of=restaurants.bin bs=512 skip=4000000 count=134
+ * Without it, a synthetic set of NUM_RESTAURANTS restaurants is used. A
+ * synthetic set of 1M restaurants is always run as well.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../rest_coords.h"
+
+#define NUM_RESTAURANTS 1066
+#define NUM_SYNTHETIC 1000000
+// RestDist::index is 16 bits, so ranges are scanned this many at a time
+#define CHUNK 65536
+
+typedef std::chrono::steady_clock bench_clock;
+
+// what manDist() does for one chunk, minus the SD card reads
+static uint32_t man_dist_records(const std::vector<restaurant> &rests, int16_t cx, int16_t cy,
+                                 uint8_t minRating, uint32_t first, uint32_t count,
+                                 RestDist *out) {
+  uint32_t k = 0;
+  for (uint32_t i = first; i < first + count; i++) {
+    const restaurant &rest = rests[i];
+    if (rating(rest.rating) >= minRating) {
+      out[k].dist = abs(cx - lon_to_x(rest.lon)) + abs(cy - lat_to_y(rest.lat));
+      out[k].index = i - first;
+      k++;
+    }
+  }
+  return k;
+}
+
+// restaurants spread uniformly over the map, with names left empty
+static std::vector<restaurant> synthetic(uint32_t n) {
+  std::vector<restaurant> rests(n);
+  srand(1);
+  for (uint32_t i = 0; i < n; i++) {
+    rests[i].lat = LAT_SOUTH + rand() % (LAT_NORTH - LAT_SOUTH);
+    rests[i].lon = LON_WEST + rand() % (LON_EAST - LON_WEST);
+    rests[i].rating = rand() % 11;
+    rests[i].name[0] = '\0';
+  }
+  return rests;
+}
+
+static bool load(const char *path, std::vector<restaurant> *rests) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  rests->resize(NUM_RESTAURANTS);
+  size_t got = fread(rests->data(), sizeof(restaurant), NUM_RESTAURANTS, f);
+  fclose(f);
+  rests->resize(got);
+  return got > 0;
+}
+
+// Runs every version over the whole set for a spread of cursor positions,
+// checks they agree and prints nanoseconds per restaurant.
+static bool run(const char *label, const std::vector<restaurant> &rests, uint8_t minRating) {
+  uint32_t n = rests.size();
+  std::vector<int16_t> x(n), y(n);
+  std::vector<uint8_t> r(n);
+  rest_coords_t rc = { x.data(), y.data(), r.data(), 0 };
+  rest_coords_fill(&rc, rests.data(), n);
+
+  std::vector<RestDist> want(CHUNK), got(CHUNK);
+  int reps = n < CHUNK ? 20000 : 50;
+  double ns[3];
+  volatile uint32_t sink = 0;
+
+  for (int version = 0; version < 3; version++) {
+    bench_clock::time_point start = bench_clock::now();
+    for (int rep = 0; rep < reps; rep++) {
+      int16_t cx = rep % MAP_WIDTH;
+      int16_t cy = (rep * 7) % MAP_HEIGHT;
+      for (uint32_t first = 0; first < n; first += CHUNK) {
+        uint32_t count = n - first < CHUNK ? n - first : CHUNK;
+        if (version == 0) {
+          sink += man_dist_records(rests, cx, cy, minRating, first, count, got.data());
+        } else if (version == 1) {
+          sink += rest_coords_dist_scalar(&rc, cx, cy, minRating, first, count, got.data());
+        } else {
+          sink += rest_coords_dist(&rc, cx, cy, minRating, first, count, got.data());
+        }
+      }
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    ns[version] = elapsed / reps / n;
+  }
+
+  for (int16_t cx = 0; cx < MAP_WIDTH; cx += 97) {
+    int16_t cy = MAP_HEIGHT - 1 - cx;
+    for (uint32_t first = 0; first < n; first += CHUNK) {
+      uint32_t count = n - first < CHUNK ? n - first : CHUNK;
+      uint32_t k1 = man_dist_records(rests, cx, cy, minRating, first, count, want.data());
+      uint32_t k2 = rest_coords_dist(&rc, cx, cy, minRating, first, count, got.data());
+      bool same = (k1 == k2);
+      for (uint32_t i = 0; same && i < k1; i++) {
+        same = want[i].index == got[i].index && want[i].dist == got[i].dist;
+      }
+      if (!same) {
+        printf("%s: rest_coords_dist() disagrees with manDist() at (%d, %d)\n", label, cx, cy);
+        return false;
+      }
+    }
+  }
+
+  printf("%-10s %8u  rating >= %u  %8.2f  %8.2f  %8.2f\n",
+         label, n, minRating, ns[0], ns[1], ns[2]);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+#if defined(__AVX2__)
+  const char *kernel = "AVX2";
+#elif defined(__SSE4_1__)
+  const char *kernel = "SSE4.1";
+#else
+  const char *kernel = "scalar";
+#endif
+  std::vector<restaurant> small;
+  const char *label = "card";
+  if (argc < 2 || !load(argv[1], &small)) {
+    if (argc >= 2) {
+      printf("Could not read %s, using synthetic data\n", argv[1]);
+    }
+    small = synthetic(NUM_RESTAURANTS);
+    label = "synthetic";
+  }
+  std::vector<restaurant> big = synthetic(NUM_SYNTHETIC);
+
+  printf("ns per restaurant, kernel built as %s\n", kernel);
+  printf("%-10s %8s  %-11s  %8s  %8s  %8s\n",
+         "data", "count", "filter", "records", "soa", "kernel");
+  bool ok = true;
+  for (uint8_t minRating = 1; minRating <= 5; minRating += 2) {
+    ok &= run(label, small, minRating);
+  }
+  for (uint8_t minRating = 1; minRating <= 5; minRating += 2) {
+    ok &= run("synthetic", big, minRating);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+/*
+ * Recording and deterministic replay of joystick and touch screen input,
+ * with per-frame timing for tracking down slow panning or list scrolling.
+ */
+
+#include "input_trace.h"
+
+#if INPUT_TRACE != TRACE_OFF
+
+#include <SD.h>
+#include <stdlib.h>
+
+trace_stats_t trace_stats;
+
+#if INPUT_TRACE == TRACE_REPLAY
+typedef struct {
+  char type;  // 'A', 'D' or 'T'
+  int16_t vals[3];  // pin and value, or x, y and z for the touch screen
+} sample_t;
+
+static File traceFile;
+// Samples are read ahead between frames, so the file reads (which share the
+// SD library's block cache with the map image) are not part of the frame time.
+static sample_t samples[TRACE_BUFFER];
+static uint8_t sampleHead = 0;
+static uint8_t sampleCount = 0;
+// time spent reading samples in the middle of the current frame
+static uint32_t replayTime = 0;
+static uint32_t frameStart = 0;
+static uint32_t frameNum = 0;
+static uint32_t busyFrames = 0;
+static uint32_t maxFrameTime = 0;
+static uint32_t totalFrameTime = 0;
+static uint32_t totalSdReads = 0;
+static uint32_t totalSdWrites = 0;
+static uint32_t totalPixels = 0;
+static uint32_t totalTransactions = 0;
+
+// prints the totals for the whole replay and halts
+static void trace_finish(const char *reason) {
+  Serial.print("trace end: ");
+  Serial.println(reason);
+  Serial.print("frames ");
+  Serial.print(frameNum);
+  Serial.print(" busy ");
+  Serial.print(busyFrames);
+  Serial.print(" total_us ");
+  Serial.print(totalFrameTime);
+  Serial.print(" max_us ");
+  Serial.print(maxFrameTime);
+  Serial.print(" sd ");
+  Serial.print(totalSdReads);
+  Serial.print(" sdw ");
+  Serial.print(totalSdWrites);
+  Serial.print(" px ");
+  Serial.print(totalPixels);
+  Serial.print(" tx ");
+  Serial.println(totalTransactions);
+  traceFile.close();
+  while (true) {}
+}
+
+// Parses a line written by record() in the recording build. Returns false if
+// it is not a complete sample.
+static bool parse_sample(const char *line, sample_t *sample) {
+  if (line[0] != '#' || (line[1] != 'A' && line[1] != 'D' && line[1] != 'T')) {
+    return false;
+  }
+  sample->type = line[1];
+  int nvals = (sample->type == 'T') ? 3 : 2;
+  char *p = (char *) line + 2;
+  char *end;
+  strtoul(p, &end, 10);  // the timestamp is only there for reading the trace
+  if (end == p) {
+    return false;
+  }
+  p = end;
+  sample->vals[2] = 0;
+  for (int i = 0; i < nvals; i++) {
+    sample->vals[i] = strtol(p, &end, 10);
+    if (end == p) {
+      return false;
+    }
+    p = end;
+  }
+  // nothing but the line ending may follow
+  while (*p == ' ' || *p == '\r') {
+    p++;
+  }
+  return *p == '\0';
+}
+
+// defined with the rest of the replay code below
+static void fill_samples();
+#endif
+
+void trace_begin() {
+#if INPUT_TRACE == TRACE_REPLAY
+  traceFile = SD.open(TRACE_FILE);
+  if (!traceFile) {
+    Serial.print("Trace file not found:'");
+    Serial.print(TRACE_FILE);
+    Serial.println('\'');
+    while (true) {}
+  }
+  fill_samples();
+  frameStart = micros();
+#endif
+  // setup() reads and draws a lot, none of it belongs to the first frame
+  trace_stats.sdReads = 0;
+  trace_stats.sdWrites = 0;
+  trace_stats.pixels = 0;
+  trace_stats.transactions = 0;
+}
+
+void trace_frame() {
+#if INPUT_TRACE == TRACE_REPLAY
+  uint32_t frameTime = micros() - frameStart - replayTime;
+
+  // quick frames that didn't draw or read anything are only counted,
+  // otherwise mode1() floods the serial port
+  if (trace_stats.sdReads > 0 || trace_stats.sdWrites > 0 || trace_stats.transactions > 0 ||
+      frameTime >= TRACE_SLOW_US) {
+    busyFrames++;
+    Serial.print("frame ");
+    Serial.print(frameNum);
+    Serial.print(" us ");
+    Serial.print(frameTime);
+    Serial.print(" sd ");
+    Serial.print(trace_stats.sdReads);
+    Serial.print(" sdw ");
+    Serial.print(trace_stats.sdWrites);
+    Serial.print(" px ");
+    Serial.print(trace_stats.pixels);
+    Serial.print(" tx ");
+    Serial.println(trace_stats.transactions);
+  }
+  maxFrameTime = max(maxFrameTime, frameTime);
+  totalFrameTime += frameTime;
+  totalSdReads += trace_stats.sdReads;
+  totalSdWrites += trace_stats.sdWrites;
+  totalPixels += trace_stats.pixels;
+  totalTransactions += trace_stats.transactions;
+  frameNum++;
+  fill_samples();
+#endif
+  trace_stats.sdReads = 0;
+  trace_stats.sdWrites = 0;
+  trace_stats.pixels = 0;
+  trace_stats.transactions = 0;
+#if INPUT_TRACE == TRACE_REPLAY
+  // don't charge the report or reading ahead to the next frame
+  replayTime = 0;
+  frameStart = micros();
+#endif
+}
+
+#if INPUT_TRACE == TRACE_RECORD
+
+// Each sample is one line, "#A <millis> <pin> <value>" for analogRead(),
+// "#D ..." for digitalRead() and "#T <millis> <x> <y> <z>" for the touch screen.
+// The '#' keeps them apart from everything else printed over serial.
+static void record(char type, int a, int b, int c) {
+  Serial.print('#');
+  Serial.print(type);
+  Serial.print(' ');
+  Serial.print(millis());
+  Serial.print(' ');
+  Serial.print(a);
+  Serial.print(' ');
+  Serial.print(b);
+  if (type == 'T') {
+    Serial.print(' ');
+    Serial.print(c);
+  }
+  Serial.println();
+}
+
+int trace_analog_read(uint8_t pin) {
+  int val = analogRead(pin);
+  record('A', pin, val, 0);
+  return val;
+}
+
+int trace_digital_read(uint8_t pin) {
+  int val = digitalRead(pin);
+  record('D', pin, val, 0);
+  return val;
+}
+
+TSPoint trace_get_point(TouchScreen &ts) {
+  TSPoint p = ts.getPoint();
+  record('T', p.x, p.y, p.z);
+  return p;
+}
+
+#else  // TRACE_REPLAY
+
+// Reads the next sample line, skipping anything that is not one (e.g.
+// restaurant names and sort timings captured along with the trace).
+// Returns false at the end of the file.
+static bool read_sample(sample_t *sample) {
+  char line[40];
+  while (true) {
+    int len = 0;
+    int c;
+    bool tooLong = false;
+    while ((c = traceFile.read()) >= 0 && c != '\n') {
+      if (len < (int) sizeof(line) - 1) {
+        line[len++] = c;
+      } else {
+        tooLong = true;
+      }
+    }
+    line[len] = '\0';
+    if (c < 0 && len == 0) {
+      return false;
+    }
+    if (!tooLong && parse_sample(line, sample)) {
+      return true;
+    }
+  }
+}
+
+// Tops up the sample buffer from the trace file
+static void fill_samples() {
+  while (sampleCount < TRACE_BUFFER) {
+    sample_t *sample = &samples[(sampleHead + sampleCount) % TRACE_BUFFER];
+    if (!read_sample(sample)) {
+      return;
+    }
+    sampleCount++;
+  }
+}
+
+// Takes the next sample from the buffer into vals[]. Ends the replay if the
+// trace runs out or the program asks for a different kind of sample than
+// was recorded, since the replay has diverged from the recording then.
+static void replay(char type, int *vals) {
+  if (sampleCount == 0) {
+    // more samples in one frame than the buffer holds, leave the
+    // time spent reading them out of the frame time
+    uint32_t start = micros();
+    fill_samples();
+    replayTime += micros() - start;
+  }
+  if (sampleCount == 0) {
+    trace_finish("out of samples");
+  }
+  sample_t *sample = &samples[sampleHead];
+  sampleHead = (sampleHead + 1) % TRACE_BUFFER;
+  sampleCount--;
+  if (sample->type != type) {
+    trace_finish("input diverged from recording");
+  }
+  for (int i = 0; i < 3; i++) {
+    vals[i] = sample->vals[i];
+  }
+}
+
+int trace_analog_read(uint8_t pin) {
+  int vals[3];
+  replay('A', vals);
+  if (vals[0] != pin) {
+    trace_finish("input diverged from recording");
+  }
+  return vals[1];
+}
+
+int trace_digital_read(uint8_t pin) {
+  int vals[3];
+  replay('D', vals);
+  if (vals[0] != pin) {
+    trace_finish("input diverged from recording");
+  }
+  return vals[1];
+}
+
+TSPoint trace_get_point(TouchScreen &ts) {
+  int vals[3];
+  replay('T', vals);
+  return TSPoint(vals[0], vals[1], vals[2]);
+}
+
+#endif
+
+#endif
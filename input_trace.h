@@ -0,0 +1,80 @@
+/*
+ * Recording and deterministic replay of joystick and touch screen input,
+ * with per-frame timing for tracking down slow panning or list scrolling.
+ *
+ * Build with INPUT_TRACE set to one of the modes below, e.g.
+ *   make INPUT_TRACE=1 upload && serial-mon > trace.txt
+ * then copy trace.txt to TRACE_FILE on the SD card and
+ *   make INPUT_TRACE=2 upload && serial-mon
+ * to replay it through mode0()/mode1() and get a report per frame. Sample
+ * lines start with '#', everything else in the log is skipped.
+ * Recording is limited by the serial port, so the recorded run itself is
+ * slower than normal; the replay is not.
+ */
+
+#ifndef _INPUT_TRACE_H
+#define _INPUT_TRACE_H
+
+#include <Arduino.h>
+#include <TouchScreen.h>
+
+#define TRACE_OFF    0
+#define TRACE_RECORD 1  // log every input sample over serial
+#define TRACE_REPLAY 2  // read input samples back from TRACE_FILE
+
+#ifndef INPUT_TRACE
+#define INPUT_TRACE TRACE_OFF
+#endif
+
+#define TRACE_FILE "trace.txt"
+// samples read ahead of the program when replaying
+#define TRACE_BUFFER 16
+// frames at least this long are reported even if they drew nothing
+#define TRACE_SLOW_US 20000
+
+#if INPUT_TRACE == TRACE_OFF
+
+#define trace_begin()
+#define trace_frame()
+#define trace_analog_read(pin)  analogRead(pin)
+#define trace_digital_read(pin) digitalRead(pin)
+#define trace_get_point(ts)     (ts).getPoint()
+#define TRACE_COUNT(counter, n)
+
+#else
+
+/* Work done since the start of the current frame. */
+typedef struct {
+  uint32_t sdReads;  // raw block reads plus file reads
+  uint32_t sdWrites; // raw block writes
+  uint32_t pixels;   // pixels sent to the display
+  // Display commands: an address window and each burst of pixels sent to it,
+  // or a fillRect(). print() is one fillRect() per font pixel.
+  uint32_t transactions;
+} trace_stats_t;
+
+extern trace_stats_t trace_stats;
+
+#define TRACE_COUNT(counter, n) (trace_stats.counter += (n))
+
+/* Opens the trace file when replaying and starts the first frame, dropping
+ * anything counted before it. Call it at the end of setup().
+ */
+void trace_begin();
+
+/* Marks the start of a new frame. When replaying, the frame that just
+ * ended is reported if it used the SD card, drew anything or took
+ * at least TRACE_SLOW_US.
+ */
+void trace_frame();
+
+/* Drop-in replacements for analogRead(), digitalRead() and
+ * TouchScreen::getPoint() that record or replay the sample.
+ */
+int trace_analog_read(uint8_t pin);
+int trace_digital_read(uint8_t pin);
+TSPoint trace_get_point(TouchScreen &ts);
+
+#endif
+
+#endif
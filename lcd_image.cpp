@@ -8,6 +8,7 @@
 #include <SD.h>
 
 #include "lcd_image.h"
+#include "input_trace.h"
 
 /* Draws the referenced image to the LCD screen.
  *
@@ -32,19 +33,33 @@ void lcd_image_draw(const lcd_image_t *img, MCUFRIEND_kbv *tft,
     return;  // how do we inform the caller than things went wrong?
   }
 
+  lcd_image_draw_file(img, &file, tft, icol, irow, scol, srow, width, height);
+  file.close();
+}
+
+/* Same as lcd_image_draw(), but reads from a file the caller already has
+ * open.
+ *
+ * file : the image file, opened with SD.open(img->file_name)
+ */
+void lcd_image_draw_file(const lcd_image_t *img, File *file, MCUFRIEND_kbv *tft,
+			 uint16_t icol, uint16_t irow,
+			 uint16_t scol, uint16_t srow,
+			 uint16_t width, uint16_t height)
+{
   for (uint16_t row=0; row < height; row++) {
     uint16_t pixels[width];
     // Seek to start of pixels to read from, need 32 bit arith for big images
     uint32_t pos = ( (uint32_t) irow +  (uint32_t) row) *
       (2 *  (uint32_t) img->ncols) +  (uint32_t) icol * 2;
-    file.seek(pos);
+    file->seek(pos);
 
     // Read row of pixels
-    if (file.read((uint8_t *) pixels, 2 * width) != 2 * width) {
+    if (file->read((uint8_t *) pixels, 2 * width) != 2 * width) {
       Serial.println("SD Card Read Error!");
-      file.close();
       return;
     }
+    TRACE_COUNT(sdReads, 1);
 
 		tft->startWrite();
 		// Setup display to receive window of pixels
@@ -61,7 +76,9 @@ void lcd_image_draw(const lcd_image_t *img, MCUFRIEND_kbv *tft,
       pixels[col] = pixel;
     }
     tft->pushColors(pixels, width, true);
+    TRACE_COUNT(pixels, width);
+    // the address window and the row of pixels
+    TRACE_COUNT(transactions, 2);
 		tft->endWrite();
   }
-  file.close();
 }
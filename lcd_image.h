@@ -5,6 +5,8 @@
 #ifndef _LCD_IMAGE_H
 #define _LCD_IMAGE_H
 
+#include <SD.h>
+
 typedef struct {
   char file_name[50];
   uint16_t ncols;
@@ -24,4 +26,15 @@ void lcd_image_draw(const lcd_image_t *img, MCUFRIEND_kbv *tft,
 		    uint16_t scol, uint16_t srow,
 		    uint16_t width, uint16_t height);
 
+/* Same as lcd_image_draw(), but reads from a file the caller already has
+ * open, so drawing many small patches doesn't look the image up on the SD
+ * card every time.
+ *
+ * file : the image file, opened with SD.open(img->file_name)
+ */
+void lcd_image_draw_file(const lcd_image_t *img, File *file, MCUFRIEND_kbv *tft,
+			 uint16_t icol, uint16_t irow,
+			 uint16_t scol, uint16_t srow,
+			 uint16_t width, uint16_t height);
+
 #endif
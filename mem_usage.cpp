@@ -0,0 +1,69 @@
+/*
+ * SRAM and stack usage reporting for the ATmega2560.
+ */
+
+#include "mem_usage.h"
+
+// provided by the linker script and avr-libc's malloc()
+extern uint8_t __data_start, __data_end, __bss_start, __bss_end;
+extern uint8_t __heap_start;
+extern void *__brkval;
+
+// Runs before the C runtime sets up the stack pointer and zero register,
+// so this has to be written without any help from the compiler.
+// Fills every byte from _end (end of .bss) up to __stack (RAMEND).
+void stack_paint() __attribute__ ((naked, used, section(".init1")));
+void stack_paint() {
+  __asm volatile ("    ldi r30, lo8(_end)\n"
+                  "    ldi r31, hi8(_end)\n"
+                  "    ldi r24, %0\n"
+                  "    ldi r25, hi8(__stack)\n"
+                  "    rjmp 2f\n"
+                  "1:\n"
+                  "    st Z+, r24\n"
+                  "2:\n"
+                  "    cpi r30, lo8(__stack)\n"
+                  "    cpc r31, r25\n"
+                  "    brlo 1b\n"
+                  "    breq 1b\n"
+                  :: "M" (STACK_CANARY));
+}
+
+// the first byte that belongs to neither the static data nor the heap
+static uint8_t *heap_end() {
+  return __brkval ? (uint8_t *) __brkval : &__heap_start;
+}
+
+uint16_t stack_never_used() {
+  uint8_t *p = heap_end();
+  uint8_t *sp = (uint8_t *) SP;
+  uint16_t count = 0;
+  while (p <= sp && *p == STACK_CANARY) {
+    p++;
+    count++;
+  }
+  return count;
+}
+
+uint16_t stack_free_now() {
+  return (uint8_t *) SP - heap_end();
+}
+
+void mem_report() {
+  Serial.print("SRAM: data ");
+  Serial.print(&__data_end - &__data_start);
+  Serial.print(" B, bss ");
+  Serial.print(&__bss_end - &__bss_start);
+  Serial.print(" B, heap ");
+  Serial.print(heap_end() - &__heap_start);
+  Serial.print(" B, stack ");
+  Serial.print((uint8_t *) RAMEND - (uint8_t *) SP);
+  Serial.print(" B of ");
+  Serial.print((uint8_t *) RAMEND + 1 - &__data_start);
+  Serial.println(" B total");
+  Serial.print("Stack free now: ");
+  Serial.print(stack_free_now());
+  Serial.print(" B, never used: ");
+  Serial.print(stack_never_used());
+  Serial.println(" B");
+}
@@ -0,0 +1,34 @@
+/*
+ * SRAM and stack usage reporting for the ATmega2560.
+ *
+ * At reset, all SRAM above the static data is painted with STACK_CANARY.
+ * The stack grows down into it, so the canary bytes that remain at the
+ * bottom show how deep the stack has ever gone.
+ *
+ * See also "make stack-usage" (per-function stack frames from the
+ * compiler) and "make mem-map" (largest static variables).
+ */
+
+#ifndef _MEM_USAGE_H
+#define _MEM_USAGE_H
+
+#include <Arduino.h>
+
+#define STACK_CANARY 0xc5
+
+/* Returns the number of bytes between the end of the heap and the
+ * deepest point the stack has reached since reset.
+ */
+uint16_t stack_never_used();
+
+/* Returns the number of bytes between the end of the heap and the
+ * current stack pointer.
+ */
+uint16_t stack_free_now();
+
+/* Prints the size of the static data, heap and stack, and the stack
+ * high-water mark, over serial.
+ */
+void mem_report();
+
+#endif
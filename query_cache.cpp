@@ -0,0 +1,138 @@
+/*
+ * Cache of restaurant queries, keyed by the map cell the cursor is in
+ * and the minimum rating.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "query_cache.h"
+#include "input_trace.h"
+
+// bump whenever query_entry_t changes so old blocks on the card are ignored
+#define QC_MAGIC 0x5132
+
+query_cache_stats_t query_cache_stats;
+
+static query_entry_t slots[QC_SLOTS];
+// when each slot was last used, for picking which one to replace
+static uint16_t slotUsed[QC_SLOTS];
+static uint16_t useClock = 0;
+static uint16_t dataRecords = 0;
+static uint32_t dataCrc = 0;
+// where query_cache_find() last found an entry, for query_cache_count()
+enum { FOUND_NONE, FOUND_SRAM, FOUND_SD };
+static uint8_t lastFound = FOUND_NONE;
+
+static bool same_key(const query_entry_t *e, int16_t cellX, int16_t cellY, uint8_t rating) {
+  return e->magic == QC_MAGIC && e->records == dataRecords && e->crc == dataCrc &&
+         e->cellX == cellX && e->cellY == cellY && e->rating == rating;
+}
+
+#ifdef QUERY_CACHE_SD_START
+// the block an entry for this key lives in, different keys may share one
+static uint32_t sd_block(int16_t cellX, int16_t cellY, uint8_t rating) {
+  uint16_t hash = ((uint16_t) cellX * 31 + (uint16_t) cellY) * 7 + rating;
+  return (uint32_t) QUERY_CACHE_SD_START + hash % QC_SD_BLOCKS;
+}
+#endif
+
+void query_cache_begin(uint16_t records, uint32_t crc) {
+  dataRecords = records;
+  dataCrc = crc;
+  for (int i = 0; i < QC_SLOTS; i++) {
+    slots[i].magic = 0;
+  }
+}
+
+const query_entry_t *query_cache_find(Sd2Card *card, uint8_t *scratch,
+                                      int16_t x, int16_t y, uint8_t rating) {
+  int16_t cellX = x / QC_CELL;
+  int16_t cellY = y / QC_CELL;
+  for (int i = 0; i < QC_SLOTS; i++) {
+    if (same_key(&slots[i], cellX, cellY, rating)) {
+      slotUsed[i] = ++useClock;
+      lastFound = FOUND_SRAM;
+      return &slots[i];
+    }
+  }
+
+#ifdef QUERY_CACHE_SD_START
+  // a failed read is just a miss, the query can still be made the slow way
+  bool read = card->readBlock(sd_block(cellX, cellY, rating), scratch);
+  TRACE_COUNT(sdReads, 1);
+  if (read && same_key((const query_entry_t *) scratch, cellX, cellY, rating)) {
+    query_entry_t *entry = query_cache_new(x, y, rating);
+    *entry = *(const query_entry_t *) scratch;
+    lastFound = FOUND_SD;
+    return entry;
+  }
+#endif
+
+  lastFound = FOUND_NONE;
+  return NULL;
+}
+
+void query_cache_count(bool answered) {
+  if (!answered) {
+    query_cache_stats.misses++;
+    if (lastFound != FOUND_NONE) {
+      query_cache_stats.unused++;
+    }
+  } else if (lastFound == FOUND_SD) {
+    query_cache_stats.sdHits++;
+  } else {
+    query_cache_stats.hits++;
+  }
+}
+
+query_entry_t *query_cache_new(int16_t x, int16_t y, uint8_t rating) {
+  int16_t cellX = x / QC_CELL;
+  int16_t cellY = y / QC_CELL;
+  int victim = 0;
+  for (int i = 0; i < QC_SLOTS; i++) {
+    if (same_key(&slots[i], cellX, cellY, rating)) {
+      victim = i;
+      break;
+    }
+    if (slotUsed[i] < slotUsed[victim]) {
+      victim = i;
+    }
+  }
+  query_entry_t *entry = &slots[victim];
+  slotUsed[victim] = ++useClock;
+  entry->magic = QC_MAGIC;
+  entry->records = dataRecords;
+  entry->crc = dataCrc;
+  entry->cellX = cellX;
+  entry->cellY = cellY;
+  entry->rating = rating;
+  entry->count = 0;
+  entry->qx = x;
+  entry->qy = y;
+  entry->bound = 0;
+  return entry;
+}
+
+void query_cache_save(Sd2Card *card, uint8_t *scratch, const query_entry_t *entry) {
+#ifdef QUERY_CACHE_SD_START
+  memset(scratch, 0, 512);
+  memcpy(scratch, entry, sizeof(query_entry_t));
+  if (!card->writeBlock(sd_block(entry->cellX, entry->cellY, entry->rating), scratch)) {
+    Serial.println("Query cache write failed.");
+  }
+  TRACE_COUNT(sdWrites, 1);
+#endif
+}
+
+void query_cache_report() {
+  Serial.print("Query cache: hits ");
+  Serial.print(query_cache_stats.hits);
+  Serial.print(", SD hits ");
+  Serial.print(query_cache_stats.sdHits);
+  Serial.print(", misses ");
+  Serial.print(query_cache_stats.misses);
+  Serial.print(" (");
+  Serial.print(query_cache_stats.unused);
+  Serial.println(" with an unusable entry)");
+}
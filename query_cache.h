@@ -0,0 +1,92 @@
+/*
+ * Cache of restaurant queries, keyed by the map cell the cursor is in
+ * and the minimum rating. Kept in SRAM and, if QUERY_CACHE_SD_START is
+ * defined, also in a reserved range of raw blocks on the SD card.
+ *
+ * An entry holds the closest QC_KEEP restaurants to the point the query
+ * was made from, along with their map coordinates, so a later query from
+ * anywhere in the same cell can be re-ranked exactly without the SD card.
+ */
+
+#ifndef _QUERY_CACHE_H
+#define _QUERY_CACHE_H
+
+#include <SD.h>
+
+#include "rest_coords.h"
+
+// side of a cache cell in map pixels
+#define QC_CELL 16
+// restaurants kept per entry, two pages of the list
+#define QC_KEEP 42
+// entries kept in SRAM, each one is sizeof(query_entry_t) bytes
+#define QC_SLOTS 2
+// bound value of an entry that holds every restaurant with the rating
+#define QC_COMPLETE 0xFFFF
+// raw blocks reserved on the SD card, starting at QUERY_CACHE_SD_START
+#define QC_SD_BLOCKS 1024
+
+typedef struct {
+  uint16_t magic;      // QC_MAGIC if the entry is in use
+  // number of restaurants and CRC-32 of the data the entry was made from
+  uint16_t records;
+  uint32_t crc;
+  int16_t cellX, cellY;
+  uint8_t rating;
+  uint8_t count;       // number of restaurants stored
+  int16_t qx, qy;      // the map position the query was made from
+  // Distance from (qx, qy) of the last restaurant stored. Every restaurant
+  // that was left out is at least this far away. QC_COMPLETE if none were.
+  uint16_t bound;
+  uint16_t index[QC_KEEP];
+  int16_t x[QC_KEEP];
+  int16_t y[QC_KEEP];
+} query_entry_t;
+
+typedef struct {
+  uint16_t hits;    // answered from SRAM
+  uint16_t sdHits;  // answered with one block read from the SD card
+  uint16_t misses;  // needed the full query
+  uint16_t unused;  // misses where an entry was found, but the cursor was too
+                    // far from where the query was made for it to be of use
+} query_cache_stats_t;
+
+extern query_cache_stats_t query_cache_stats;
+
+/* Sets the number of restaurants and the CRC-32 of their data. Entries on
+ * the SD card made from different data are ignored, and SRAM entries are
+ * dropped.
+ */
+void query_cache_begin(uint16_t records, uint32_t crc);
+
+/* Returns the entry for the cell containing map position (x, y) at the
+ * given rating, or NULL if there is none. Follow it with query_cache_count().
+ *
+ * card    : the card to look on if QUERY_CACHE_SD_START is defined
+ * scratch : a 512 byte buffer the block is read into, its contents are lost
+ */
+const query_entry_t *query_cache_find(Sd2Card *card, uint8_t *scratch,
+                                      int16_t x, int16_t y, uint8_t rating);
+
+/* Counts the query that the last query_cache_find() was for as a hit if
+ * answered is true, otherwise as a miss.
+ */
+void query_cache_count(bool answered);
+
+/* Returns an SRAM entry for a query from map position (x, y) at the given
+ * rating, reusing the one for the same cell or else the least recently
+ * used one. The entry starts out empty. The caller fills in the
+ * restaurants and bound as it reads them, then calls query_cache_save().
+ */
+query_entry_t *query_cache_new(int16_t x, int16_t y, uint8_t rating);
+
+/* Writes the entry to the SD card if QUERY_CACHE_SD_START is defined.
+ *
+ * scratch : a 512 byte buffer the block is built in, its contents are lost
+ */
+void query_cache_save(Sd2Card *card, uint8_t *scratch, const query_entry_t *entry);
+
+/* Prints the hit and miss counts over serial. */
+void query_cache_report();
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Restaurant records and their projection onto the map, plus a
+ * structure-of-arrays store of the projected coordinates and a
+ * Manhattan distance kernel over it, for host-side and batch use.
+ */
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include <string.h>
+
+#include "rest_coords.h"
+
+// the same arithmetic as Arduino's map(), which the host build doesn't have
+static int32_t map_range(int32_t v, int32_t inMin, int32_t inMax,
+                         int32_t outMin, int32_t outMax) {
+  return (v - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+int16_t lon_to_x(int32_t lon) {
+  return map_range(lon, LON_WEST, LON_EAST, 0, MAP_WIDTH);
+}
+
+int16_t lat_to_y(int32_t lat) {
+  return map_range(lat, LAT_NORTH, LAT_SOUTH, 0, MAP_HEIGHT);
+}
+
+uint8_t rating(uint8_t rating) {
+  int floor = (rating + 1)/2;
+  return floor > 1 ? floor : 1;
+}
+
+void rest_coords_fill(rest_coords_t *rc, const struct restaurant *rests, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    rc->x[i] = lon_to_x(rests[i].lon);
+    rc->y[i] = lat_to_y(rests[i].lat);
+    rc->rating[i] = rating(rests[i].rating);
+  }
+  rc->n = n;
+}
+
+/* Scans restaurants [from, to) and appends the ones that pass the rating
+ * filter to out, with indices relative to base. Returns how many were written.
+ */
+static uint32_t dist_range(const rest_coords_t *rc, int16_t cx, int16_t cy,
+                           uint8_t minRating, uint32_t base,
+                           uint32_t from, uint32_t to, struct RestDist *out)
+{
+  uint32_t k = 0;
+  for (uint32_t i = from; i < to; i++) {
+    if (rc->rating[i] >= minRating) {
+      int32_t dx = (int32_t) cx - rc->x[i];
+      int32_t dy = (int32_t) cy - rc->y[i];
+      out[k].dist = (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+      out[k].index = i - base;
+      k++;
+    }
+  }
+  return k;
+}
+
+uint32_t rest_coords_dist_scalar(const rest_coords_t *rc, int16_t cx, int16_t cy,
+                                 uint8_t minRating, uint32_t first, uint32_t count,
+                                 struct RestDist *out)
+{
+  return dist_range(rc, cx, cy, minRating, first, first, first + count, out);
+}
+
+uint32_t rest_coords_dist(const rest_coords_t *rc, int16_t cx, int16_t cy,
+                          uint8_t minRating, uint32_t first, uint32_t count,
+                          struct RestDist *out)
+{
+  uint32_t i = first;
+  uint32_t end = first + count;
+  uint32_t k = 0;
+
+#if defined(__AVX2__)
+  const __m256i vcx = _mm256_set1_epi32(cx);
+  const __m256i vcy = _mm256_set1_epi32(cy);
+  const __m256i vmin = _mm256_set1_epi32((int32_t) minRating - 1);
+  uint32_t dists[8];
+
+  for (; i + 8 <= end; i += 8) {
+    __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (rc->x + i)));
+    __m256i y = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (rc->y + i)));
+    __m256i r = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (rc->rating + i)));
+
+    __m256i d = _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(vcx, x)),
+                                 _mm256_abs_epi32(_mm256_sub_epi32(vcy, y)));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(r, vmin)));
+    if (mask == 0) {
+      continue;
+    }
+    _mm256_storeu_si256((__m256i *) dists, d);
+
+    // Write every lane and only advance past the ones that passed the filter.
+    // k never gets ahead of i - first, so this stays inside out[count].
+    for (int j = 0; j < 8; j++) {
+      out[k].index = i + j - first;
+      out[k].dist = dists[j];
+      k += (mask >> j) & 1;
+    }
+  }
+#elif defined(__SSE4_1__)
+  const __m128i vcx = _mm_set1_epi32(cx);
+  const __m128i vcy = _mm_set1_epi32(cy);
+  const __m128i vmin = _mm_set1_epi32((int32_t) minRating - 1);
+  uint32_t dists[4];
+
+  for (; i + 4 <= end; i += 4) {
+    __m128i x = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) (rc->x + i)));
+    __m128i y = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) (rc->y + i)));
+    int32_t r4;
+    memcpy(&r4, rc->rating + i, 4);
+    __m128i r = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(r4));
+
+    __m128i d = _mm_add_epi32(_mm_abs_epi32(_mm_sub_epi32(vcx, x)),
+                              _mm_abs_epi32(_mm_sub_epi32(vcy, y)));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(r, vmin)));
+    if (mask == 0) {
+      continue;
+    }
+    _mm_storeu_si128((__m128i *) dists, d);
+
+    for (int j = 0; j < 4; j++) {
+      out[k].index = i + j - first;
+      out[k].dist = dists[j];
+      k += (mask >> j) & 1;
+    }
+  }
+#endif
+
+  // whatever is left over (or everything, without SIMD)
+  return k + dist_range(rc, cx, cy, minRating, first, i, end, out + k);
+}
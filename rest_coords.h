@@ -0,0 +1,81 @@
+/*
+ * Restaurant records and their projection onto the map, plus a
+ * structure-of-arrays store of the projected coordinates and a
+ * Manhattan distance kernel over it, for host-side and batch use.
+ */
+
+#ifndef _REST_COORDS_H
+#define _REST_COORDS_H
+
+#include <stdint.h>
+
+// This is convert the lat/lon to x/y
+#define  MAP_WIDTH  2048
+#define  MAP_HEIGHT 2048
+#define  LAT_NORTH  5361858l
+#define  LAT_SOUTH  5340953l
+#define  LON_WEST  -11368652l
+#define  LON_EAST  -11333496l
+
+struct restaurant {  // 64 Bytes
+  int32_t lat;
+  int32_t lon;
+  uint8_t rating;  // from 0 to 10
+  char name[55];
+};
+
+struct RestDist {
+  uint16_t index;
+  uint16_t dist;
+};
+
+//  These  functions  convert  between lat/lon map  position  and  x/y
+int16_t lon_to_x(int32_t lon);
+int16_t lat_to_y(int32_t lat);
+
+/* Converts a rating from 0 to 10 into a star rating from 1 to 5. */
+uint8_t rating(uint8_t rating);
+
+/* The arrays are owned by the caller and must hold at least n entries.
+ *
+ * x, y   : map pixel coordinates, as returned by lon_to_x() and lat_to_y()
+ * rating : star rating from 1 to 5, as returned by rating()
+ * n      : number of restaurants stored
+ */
+typedef struct {
+  int16_t *x;
+  int16_t *y;
+  uint8_t *rating;
+  uint32_t n;
+} rest_coords_t;
+
+/* Projects n restaurant records into rc, whose arrays must hold n entries,
+ * and sets rc->n.
+ */
+void rest_coords_fill(rest_coords_t *rc, const struct restaurant *rests, uint32_t n);
+
+/* Fills out[] with the Manhattan distance from (cx, cy) of every restaurant
+ * in [first, first + count) whose rating is at least minRating, in index
+ * order, and returns the number of entries written. This is the same
+ * result manDist() produces, but computed 8 (AVX2) or 4 (SSE4.1)
+ * restaurants at a time when the host supports it.
+ *
+ * rc           : the coordinate store
+ * cx, cy       : the cursor position in map pixel coordinates
+ * minRating    : the lowest star rating that is kept
+ * first, count : the range of restaurants to scan, count <= 65536 since
+ *                RestDist::index is relative to first and only 16 bits
+ * out          : must have room for count entries
+ */
+uint32_t rest_coords_dist(const rest_coords_t *rc, int16_t cx, int16_t cy,
+                          uint8_t minRating, uint32_t first, uint32_t count,
+                          struct RestDist *out);
+
+/* Plain C version of rest_coords_dist(), used on the Arduino and for the
+ * tail of each range that does not fill a whole vector.
+ */
+uint32_t rest_coords_dist_scalar(const rest_coords_t *rc, int16_t cx, int16_t cy,
+                                 uint8_t minRating, uint32_t first, uint32_t count,
+                                 struct RestDist *out);
+
+#endif
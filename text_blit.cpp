@@ -0,0 +1,83 @@
+/*
+ * Fast drawing of a single line of text in the classic GFX font.
+ */
+
+#include "Adafruit_GFX.h"    // Core graphics library
+#include "MCUFRIEND_kbv.h" // Hardware-specific library
+// The same 5x7 font table Adafruit GFX uses for print(). The library keeps
+// its copy static, so this puts a second copy of the ~1.3 KB table in flash.
+#include <glcdfont.c>
+
+#include "text_blit.h"
+#include "input_trace.h"
+
+// pixels pushed to the display at a time, a multiple of the glyph width at size 2
+#define CHUNK_PIXELS 48
+
+void text_blit(MCUFRIEND_kbv *tft, const char *str,
+               int16_t x, int16_t y, uint8_t size, uint8_t rows,
+               uint16_t fg, uint16_t bg)
+{
+  uint16_t glyphWidth = 6 * size;
+  if (x < 0 || x >= tft->width()) {
+    return;
+  }
+  uint16_t maxChars = (tft->width() - x) / glyphWidth;
+  if (maxChars > TEXT_BLIT_MAX_CHARS) {
+    maxChars = TEXT_BLIT_MAX_CHARS;
+  }
+  uint16_t nchars = 0;
+  while (str[nchars] != '\0' && nchars < maxChars) {
+    nchars++;
+  }
+  if (nchars == 0) {
+    return;
+  }
+  if (rows > 8 * size) {
+    rows = 8 * size;
+  }
+
+  uint16_t width = nchars * glyphWidth;
+  uint16_t pixels[CHUNK_PIXELS];
+
+  tft->startWrite();
+  // the whole line is one window, filled row by row
+  tft->setAddrWindow(x, y, x + width - 1, y + rows - 1);
+  TRACE_COUNT(transactions, 1);
+  bool first = true;
+  for (uint8_t row = 0; row < rows; row++) {
+    uint8_t mask = 1 << (row / size);
+    uint16_t n = 0;
+    for (uint16_t i = 0; i < nchars; i++) {
+      uint8_t c = str[i];
+      // print() skips a character in the font table from here on
+      if (c >= 176) {
+        c++;
+      }
+      // Each glyph is 5 columns of 8 bits (bit 0 at the top) plus a blank
+      // column. They are read from flash again for every row rather than
+      // copied out once, which keeps the string off the stack.
+      for (uint8_t col = 0; col < 6; col++) {
+        uint8_t bits = (col < 5) ? pgm_read_byte(&font[c * 5 + col]) : 0;
+        uint16_t colour = (bits & mask) ? fg : bg;
+        for (uint8_t s = 0; s < size; s++) {
+          pixels[n++] = colour;
+          if (n == CHUNK_PIXELS) {
+            tft->pushColors(pixels, n, first);
+            TRACE_COUNT(pixels, n);
+            TRACE_COUNT(transactions, 1);
+            first = false;
+            n = 0;
+          }
+        }
+      }
+    }
+    if (n > 0) {
+      tft->pushColors(pixels, n, first);
+      TRACE_COUNT(pixels, n);
+      TRACE_COUNT(transactions, 1);
+      first = false;
+    }
+  }
+  tft->endWrite();
+}
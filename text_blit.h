@@ -0,0 +1,29 @@
+/*
+ * Fast drawing of a single line of text in the classic GFX font.
+ */
+
+#ifndef _TEXT_BLIT_H
+#define _TEXT_BLIT_H
+
+// the longest string text_blit() will draw, longer ones are cut off.
+// A 480 pixel wide screen fits 40 characters at size 2.
+#define TEXT_BLIT_MAX_CHARS 40
+
+/* Draws str with the upper-left corner at (x, y), the same as
+ * setCursor(x, y), setTextSize(size), setTextColor(fg, bg) and print(str)
+ * with text wrap off, but as one window of pixels sent in a single burst
+ * instead of a fillRect() per font pixel.
+ *
+ * tft    : the initialized tft struct
+ * str    : the text, anything past the right edge of the screen is clipped
+ * x, y   : the upper-left corner of the screen to draw to
+ * size   : the text size, each font pixel becomes size x size pixels
+ * rows   : how many pixel rows of the text to draw, at most 8*size.
+ *          Lines of text closer together than 8*size would overlap anyway.
+ * fg, bg : the text and background colours
+ */
+void text_blit(MCUFRIEND_kbv *tft, const char *str,
+               int16_t x, int16_t y, uint8_t size, uint8_t rows,
+               uint16_t fg, uint16_t bg);
+
+#endif